@@ -0,0 +1,39 @@
+# Online co-op over loopback, run by the `net_loopback` test (or directly with cmake -P).
+# A host and a joiner play the same scripted session as two processes on 127.0.0.1,
+# both sending through injected latency, jitter and loss. Each one fails by itself on
+# a desync or if no checksum was ever compared; this also checks that both finished
+# on the same final state.
+#
+# Inputs: GAME, WORK_DIR, PORT
+cmake_minimum_required(VERSION 3.21)
+
+set(LINK_ARGS --latency 50 --jitter 30 --loss 10 --ticks 600)
+set(hostResult "${WORK_DIR}/net_host.txt")
+set(joinResult "${WORK_DIR}/net_join.txt")
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(REMOVE ${hostResult} ${joinResult})
+
+# The COMMANDs of one execute_process run at the same time
+execute_process(
+    COMMAND ${GAME} --net-soak host --port ${PORT} ${LINK_ARGS} --result ${hostResult}
+    COMMAND ${GAME} --net-soak join --peer 127.0.0.1:${PORT} ${LINK_ARGS} --result ${joinResult}
+    RESULTS_VARIABLE results
+    TIMEOUT 120)
+
+foreach(side host join)
+    if(NOT EXISTS "${${side}Result}")
+        message(FATAL_ERROR "net_loopback: the ${side} wrote no result (exit codes: ${results})")
+    endif()
+    file(READ "${${side}Result}" report)
+    string(STRIP "${report}" report)
+    message(STATUS "${side}: ${report}")
+    string(REGEX MATCH "checksum ([0-9a-f]+)" unused "${report}")
+    set(${side}Checksum "${CMAKE_MATCH_1}")
+endforeach()
+
+if(NOT results STREQUAL "0;0")
+    message(FATAL_ERROR "net_loopback: a peer failed (exit codes: ${results})")
+endif()
+if(NOT hostChecksum STREQUAL joinChecksum)
+    message(FATAL_ERROR "net_loopback: final states differ (host ${hostChecksum}, join ${joinChecksum})")
+endif()
@@ -0,0 +1,177 @@
+# Replay-driven PGO pipeline, run by the `pgo` target (or directly with cmake -P):
+#   1. baseline: Release + LTO, no profiles
+#   2. instrumented: SV_PGO=GENERATE, then trained on the recorded replays
+#   3. optimized: the same build directory reconfigured with SV_PGO=USE
+# Both finished games then run the benchmark suite in alternating rounds and the
+# speedup per case is reported and written to WORK_DIR/pgo_report.txt.
+#
+# Inputs: SOURCE_DIR, WORK_DIR, GENERATOR, CXX_COMPILER, C_COMPILER, COMPILER_ID, FETCH_DEPS,
+# REPLAYS, and the parent build's dependencies (RAYLIB_DIR or RAYLIB_SOURCE_DIR, and
+# RAYGUI_INCLUDE_DIR) so the stage builds reuse them instead of fetching again.
+cmake_minimum_required(VERSION 3.21)
+
+set(baselineDir "${WORK_DIR}/baseline")
+set(pgoDir "${WORK_DIR}/optimized")
+set(profileDir "${WORK_DIR}/profiles")
+set(TRAINING_LOOPS 5)
+set(BENCH_ARGS --max-count 10000 --min-time 0.25)
+set(BENCH_ROUNDS 2)
+
+function(run_checked)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        string(REPLACE ";" " " commandLine "${ARGN}")
+        message(FATAL_ERROR "PGO: failed (${result}): ${commandLine}")
+    endif()
+endfunction()
+
+set(dependencyArgs -DRAYGUI_INCLUDE_DIR=${RAYGUI_INCLUDE_DIR})
+if(RAYLIB_DIR)
+    list(APPEND dependencyArgs -Draylib_DIR=${RAYLIB_DIR})
+elseif(RAYLIB_SOURCE_DIR)
+    list(APPEND dependencyArgs -DFETCHCONTENT_SOURCE_DIR_RAYLIB=${RAYLIB_SOURCE_DIR})
+endif()
+
+function(configure_and_build dir pgoStage)
+    run_checked(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${dir} -G "${GENERATOR}"
+        -DCMAKE_BUILD_TYPE=Release
+        -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+        -DCMAKE_C_COMPILER=${C_COMPILER}
+        -DSV_FETCH_DEPS=${FETCH_DEPS}
+        -DSV_LTO=ON
+        -DSV_PGO=${pgoStage}
+        -DSV_PGO_DIR=${profileDir}
+        ${dependencyArgs})
+    run_checked(${CMAKE_COMMAND} --build ${dir} --config Release --target space_venture)
+endfunction()
+
+# Single- and multi-config generators put the executable in different places
+function(find_game dir outVar)
+    foreach(candidate "${dir}/space_venture" "${dir}/space_venture.exe" "${dir}/Release/space_venture.exe")
+        if(EXISTS "${candidate}")
+            set(${outVar} "${candidate}" PARENT_SCOPE)
+            return()
+        endif()
+    endforeach()
+    message(FATAL_ERROR "PGO: no space_venture executable under ${dir}")
+endfunction()
+
+# string(JSON) hands back doubles like 48.340000000000003
+function(to_hundredths value outVar)
+    string(REGEX MATCH "^([0-9]+)\\.?([0-9]*)" unused "${value}")
+    set(fraction "${CMAKE_MATCH_2}00")
+    string(SUBSTRING "${fraction}" 0 2 fraction)
+    math(EXPR hundredths "${CMAKE_MATCH_1} * 100 + 1${fraction} - 100")
+    set(${outVar} ${hundredths} PARENT_SCOPE)
+endfunction()
+
+function(format_milli milli outVar)
+    math(EXPR whole "${milli} / 1000")
+    math(EXPR frac "${milli} % 1000 + 1000")
+    string(SUBSTRING "${frac}" 1 2 frac)
+    set(${outVar} "${whole}.${frac}" PARENT_SCOPE)
+endfunction()
+
+function(pad_right text width outVar)
+    string(LENGTH "${text}" length)
+    if(length LESS width)
+        math(EXPR padding "${width} - ${length}")
+        string(REPEAT " " ${padding} spaces)
+        string(APPEND text "${spaces}")
+    endif()
+    set(${outVar} "${text}" PARENT_SCOPE)
+endfunction()
+
+# Sets <prefix>_<name>/<count> to ns/op in hundredths, keeping the fastest across rounds
+function(read_bench jsonFile prefix)
+    file(READ "${jsonFile}" json)
+    string(JSON count LENGTH "${json}" benchmarks)
+    set(names "")
+    if(count GREATER 0)
+        math(EXPR last "${count} - 1")
+        foreach(i RANGE ${last})
+            string(JSON name GET "${json}" benchmarks ${i} name)
+            string(JSON entities GET "${json}" benchmarks ${i} count)
+            string(JSON ns GET "${json}" benchmarks ${i} ns_per_op)
+            set(key "${prefix}_${name}/${entities}")
+            list(APPEND names "${name}/${entities}")
+            to_hundredths(${ns} hundredths)
+            if(NOT DEFINED ${key} OR hundredths LESS "${${key}}")
+                set(${key} ${hundredths} PARENT_SCOPE)
+            endif()
+        endforeach()
+    endif()
+    set(${prefix}_NAMES "${names}" PARENT_SCOPE)
+endfunction()
+
+# 1. Baseline
+configure_and_build(${baselineDir} OFF)
+find_game(${baselineDir} baselineGame)
+
+# 2. Instrumented build and training
+file(REMOVE_RECURSE ${profileDir})
+file(MAKE_DIRECTORY ${profileDir})
+configure_and_build(${pgoDir} GENERATE)
+find_game(${pgoDir} instrumentedGame)
+if(REPLAYS)
+    foreach(replay IN LISTS REPLAYS)
+        message(STATUS "PGO: training on ${replay}")
+        run_checked(${instrumentedGame} --replay ${replay} --loops ${TRAINING_LOOPS})
+    endforeach()
+else()
+    message(WARNING "PGO: no replays/*.svrp recorded; training on the scripted stress replay only")
+endif()
+# Crowded levels cover the paths the small shipped levels barely touch
+run_checked(${instrumentedGame} --stress --update-baseline --baseline ${WORK_DIR}/training_baseline.txt)
+
+if(COMPILER_ID MATCHES "Clang")
+    find_program(LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+    file(GLOB rawProfiles "${profileDir}/*.profraw")
+    run_checked(${LLVM_PROFDATA} merge -output=${profileDir}/space_venture.profdata ${rawProfiles})
+endif()
+
+# 3. Optimized build from the profiles
+configure_and_build(${pgoDir} USE)
+find_game(${pgoDir} optimizedGame)
+
+# Compare on the benchmark suite, alternating the games so drift hits both alike
+foreach(round RANGE 1 ${BENCH_ROUNDS})
+    run_checked(${baselineGame} --bench ${BENCH_ARGS} --json ${WORK_DIR}/bench_baseline_${round}.json)
+    run_checked(${optimizedGame} --bench ${BENCH_ARGS} --json ${WORK_DIR}/bench_pgo_${round}.json)
+    read_bench(${WORK_DIR}/bench_baseline_${round}.json base)
+    read_bench(${WORK_DIR}/bench_pgo_${round}.json pgo)
+endforeach()
+
+set(report "benchmark                        baseline ns/op   PGO ns/op    speedup\n")
+set(milliSum 0)
+set(compared 0)
+foreach(key IN LISTS base_NAMES)
+    if(NOT DEFINED pgo_${key})
+        continue()
+    endif()
+    # math() is integer only, so times are compared in hundredths of a nanosecond
+    set(before ${base_${key}})
+    set(after ${pgo_${key}})
+    if(after LESS 1)
+        continue()
+    endif()
+    math(EXPR milli "${before} * 1000 / ${after}")
+    format_milli(${milli} speedup)
+    math(EXPR beforeNs "${before} / 100")
+    math(EXPR afterNs "${after} / 100")
+    pad_right("${key}" 32 keyColumn)
+    pad_right("${beforeNs}" 16 beforeColumn)
+    pad_right("${afterNs}" 12 afterColumn)
+    string(APPEND report "${keyColumn} ${beforeColumn} ${afterColumn} ${speedup}x\n")
+    math(EXPR milliSum "${milliSum} + ${milli}")
+    math(EXPR compared "${compared} + 1")
+endforeach()
+if(compared GREATER 0)
+    math(EXPR meanMilli "${milliSum} / ${compared}")
+    format_milli(${meanMilli} meanSpeedup)
+    string(APPEND report "mean speedup over ${compared} cases: ${meanSpeedup}x\n")
+endif()
+
+file(WRITE ${WORK_DIR}/pgo_report.txt "${report}")
+message("${report}")
+message(STATUS "PGO: optimized game at ${optimizedGame}")